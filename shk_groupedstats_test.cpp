@@ -0,0 +1,54 @@
+// Sample usage program for GroupedStats class.
+
+#include <iostream>
+#include "shk_stats.h"
+using namespace std;
+using namespace shk;
+
+const int N=16;
+
+// data set A, sampled for groups with integer keys K and string keys S
+double A[] = { 88., 12., 0. , 34., 77., 95., 12., 2. ,
+               99., 6. , 88., 45., 76., 46., 3. , 12. };
+int K[] = { 7, 0, 7, 1000000, 0, 0, 7, 1000000,
+            0, 7, 7, 0, 1000000, 1000000, 0, 7 };
+const char* S[] = { "web", "db", "web", "cache", "db", "db", "web", "cache",
+                    "db", "web", "web", "db", "cache", "cache", "db", "web" };
+
+GroupedStats G(0.,100.,10);
+GroupedStats H(0.,100.,10);
+
+
+int main()
+{
+    G.takeSamples(K,A,N);
+
+    for (unsigned i=0; i<G.getGroupCount(); i++)
+    {
+        cout << "\nGroup " << G.getKey(i);
+        G.getGroup(i)->printStats("A",10,4,1);
+    }
+    G.getStats(0)->printHistogram("A",8,4);
+
+    for (int i=0; i<N; i++)
+        H.takeSampleByName(S[i],A[i]);
+
+    H.mergeStats(H); // doubles the counts, keeps mean, min and max
+    for (unsigned i=0; i<H.getGroupCount(); i++)
+    {
+        H.getGroup(i)->printStats((char*) H.getName(i),10,4,0);
+        cout << "\n";
+    }
+
+    if (H.findStatsByName("none") == NULL)
+        cout << "no group named none\n";
+
+    G.resetStats();
+    G.takeSample(7,50.);
+    G.findStats(7)->printHistogram("A",8,4);
+
+    G.clearGroups();
+    cout << "groups after clear: " << G.getGroupCount() << "\n";
+
+    return 0;
+}
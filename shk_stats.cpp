@@ -3,6 +3,9 @@
 #include <math.h>
 #include <float.h>
 #include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <limits>
 #include <iostream>
 #include <iomanip>
 using namespace std;
@@ -11,6 +14,9 @@ using namespace std;
 namespace shk 
 {
 
+// returned by statistics that do not exist when errors are not fatal
+static const double NOT_A_NUMBER = numeric_limits<double>::quiet_NaN();
+
 
 /*---------------------------------------------------------------
 Stats Functions
@@ -20,12 +26,28 @@ Stats Functions
 Stats::Stats(void)
 {
     histo = false;
+    ownhisto = false;
+    fatal = true;
     resetStats();
 }
 
 
 // class constructor (with histogram)
 Stats::Stats(double low, double high, int bins)
+{
+    initHistogram(low, high, bins, NULL);
+}
+
+
+// class constructor (with histogram in storage of at least bins+2 bins, owned by the caller)
+Stats::Stats(double low, double high, int bins, unsigned* storage)
+{
+    initHistogram(low, high, bins, storage);
+}
+
+
+// common part of constructors with histogram (allocates histogram if storage is NULL)
+void Stats::initHistogram(double low, double high, int bins, unsigned* storage)
 {
     if (!((low<high) && (bins>0))) // input check
     {
@@ -34,11 +56,13 @@ Stats::Stats(double low, double high, int bins)
     }
 
     histo = true;
+    fatal = true;
     lo = low;
     hi = high;
     nbin = bins;
     bin = (hi - lo) / nbin;
-    histogram = new unsigned[nbin+2];
+    ownhisto = (storage == NULL);
+    histogram = ownhisto ? new unsigned[nbin+2] : storage;
     resetStats();
 }
 
@@ -46,7 +70,7 @@ Stats::Stats(double low, double high, int bins)
 // class destructor
 Stats::~Stats(void)
 {
-    if (histo) delete [] histogram;;
+    if (histo && ownhisto) delete [] histogram;
 }
 
 
@@ -54,6 +78,7 @@ Stats::~Stats(void)
 void Stats::resetStats(void)
 {
     count = 0;
+    errors = 0;
     sum = 0.;
     sumsq = 0.;
     min = DBL_MAX;
@@ -64,32 +89,12 @@ void Stats::resetStats(void)
 }
 
 
-// take one data sample
-void Stats::takeSample(double x)
-{
-    count++ ;
-    sum += x;
-    sumsq += (x * x);
-    if (x < min) min = x;
-    if (x > max) max = x;
-
-    if (histo)
-    {
-        if ( x < lo ) { histogram[0]++; return; }
-        if ( x > hi ) { histogram[nbin+1]++; return; }
-
-        int i = ( (int) ((x - lo) / bin )) + 1;
-        histogram[i]++;
-    }
-    return;
-}
-
-
 // compute mean of samples
 double Stats::calcMean(void)
 {
     if (count < 1)
     {
+        if (!fatal) return NOT_A_NUMBER;
         cerr<< "fatal error: Stats::calcMean() => samples < 1 !\n";
         exit(1);
     }
@@ -102,6 +107,7 @@ double Stats::calcVariance(void)
 {
     if (count < 2)
     {
+        if (!fatal) return NOT_A_NUMBER;
         cerr<< "fatal error: Stats::calcVariance() => samples < 2 !\n";
         exit(1);
     }
@@ -116,11 +122,63 @@ double Stats::calcStDev(void)
 }
 
 
+// get mean of samples; returns false if there are no samples
+bool Stats::calcMean(double& mean)
+{
+    if (count < 1) return false;
+    mean = sum/count;
+    return true;
+}
+
+
+// get unbiased variance of samples; returns false if there are less than 2 samples
+bool Stats::calcVariance(double& var)
+{
+    if (count < 2) return false;
+    var = (sumsq - (sum*sum)/count)/(count-1);
+    return true;
+}
+
+
+// get unbiased standard deviation of samples; returns false if there are less than 2 samples
+bool Stats::calcStDev(double& stdev)
+{
+    double var;
+    if (!calcVariance(var)) return false;
+    stdev = sqrt(var);
+    return true;
+}
+
+
+// get minimum of samples; returns false if there are no samples
+bool Stats::calcMin(double& m)
+{
+    if (count < 1) return false;
+    m = min;
+    return true;
+}
+
+
+// get maximum of samples; returns false if there are no samples
+bool Stats::calcMax(double& m)
+{
+    if (count < 1) return false;
+    m = max;
+    return true;
+}
+
+
 // print statistics
 void Stats::printStats(char* varname, int width, int precision, int verbose)
 {
     if (count < 2)
     {
+        if (!fatal)
+        {
+            cerr << "warning: Stats::printStats(): samples < 2, no statistics to print! ";
+            cerr << "(" << errors << " rejected samples)\n\n";
+            return;
+        }
         cerr<< "fatal error: Stats::printStats() => samples < 2 !\n";
         exit(1);
     }
@@ -137,6 +195,7 @@ void Stats::printStats(char* varname, int width, int precision, int verbose)
         cout << "Sample Standard Dev : " << setw(width) << calcStDev() << "\n";
         cout << "Sample Min          : " << setw(width) << calcMin() << "\n";
         cout << "Sample Max          : " << setw(width) << calcMax();
+        if (errors) cout << "\nRejected Samples    : " << setw(width) << errors;
         cout << "\n----------------------------------------\n";
     }
     else
@@ -147,6 +206,7 @@ void Stats::printStats(char* varname, int width, int precision, int verbose)
         cout << setw(width) << calcStDev() << " ";
         cout << setw(width) << calcMin() << " ";
         cout << setw(width) << calcMax() << " ";
+        if (errors) cout << setw(width) << errors << " rejected ";
     }
 }
 
@@ -156,6 +216,12 @@ void Stats::printHistogram(char* varname, int width, int precision)
 {
     if (count < 1)
     {
+        if (!fatal)
+        {
+            cerr << "warning: Stats::printHistogram(): no samples, no histogram to print! ";
+            cerr << "(" << errors << " rejected samples)\n\n";
+            return;
+        }
         cerr<< "fatal error: Stats::printHistogram() => samples < 1 !\n";
         exit(1);
     }
@@ -188,6 +254,33 @@ void Stats::printHistogram(char* varname, int width, int precision)
 
 
 
+// add samples of another Stats object into this one
+void Stats::mergeStats(Stats& other)
+{
+    if ((histo != other.histo) ||
+        (histo && !((lo == other.lo) && (hi == other.hi) && (nbin == other.nbin))))
+    {
+        if (!fatal)
+        {
+            cerr << "warning: Stats::mergeStats(): histograms do not match, nothing merged!\n\n";
+            return;
+        }
+        cerr<< "fatal error: Stats::mergeStats() => histograms do not match!\n";
+        exit(1);
+    }
+
+    count += other.count;
+    errors += other.errors;
+    sum += other.sum;
+    sumsq += other.sumsq;
+    if (other.min < min) min = other.min;
+    if (other.max > max) max = other.max;
+    if (histo)
+        for (int i=0; i < nbin+2; i++)
+            histogram[i] += other.histogram[i];
+}
+
+
 /*---------------------------------------------------------------
 TStats Functions
 ---------------------------------------------------------------*/
@@ -196,6 +289,7 @@ TStats Functions
 TStats::TStats(void)
 {
     histo = false;
+    fatal = true;
     resetTStats();
 }
 
@@ -210,6 +304,7 @@ TStats::TStats(double low, double high, int bins)
     }
 
     histo = true;
+    fatal = true;
     lo = low;
     hi = high;
     nbin = bins;
@@ -230,6 +325,7 @@ TStats::~TStats(void)
 void TStats::resetTStats()
 {
     tnow = 0.;
+    errors = 0;
     sum = 0.;
     sumsq = 0.;
     min = DBL_MAX;
@@ -240,34 +336,22 @@ void TStats::resetTStats()
 }
 
 
-// take one data sample x, along with the time of sample tx
-void TStats::takeSample(double x, double tx)
+// count a sample rejected by takeSample(); tdiff is its time advance
+void TStats::rejectSample(double tdiff)
 {
-    double tdiff = tx - tnow;
-    if (tdiff<=0.) { cerr <<"fatal: TStats::takeSample(): negative time advance!\n"; exit(1); }
-    tnow = tx;
-    sum += (x * tdiff);
-    sumsq += ( x * x * tdiff);
-
-    if (x < min) min = x;
-    if (x > max) max = x;
-
-    if (histo)
-    {
-        if ( x < lo ) { histogram[0] += tdiff; return; }
-        if ( x > hi ) { histogram[nbin+1] += tdiff; return; }
-
-        int i = ( (int) ((x - lo) / bin )) + 1;
-        histogram[i] += tdiff;
-    }
-    return;
+    errors++;
+    if (fatal && (tdiff <= 0.)) { cerr <<"fatal: TStats::takeSample(): negative time advance!\n"; exit(1); }
 }
 
 
 // compute mean of samples
 double TStats::calcMean(void)
 {
-    if (tnow <= 0.) { cerr<< "fatal error: TStats::calcMean() => no samples!\n"; exit(1); }
+    if (tnow <= 0.)
+    {
+        if (!fatal) return NOT_A_NUMBER;
+        cerr<< "fatal error: TStats::calcMean() => no samples!\n"; exit(1);
+    }
     return (sum/tnow);
 }
 
@@ -275,17 +359,68 @@ double TStats::calcMean(void)
 // compute unbiased standard deviation of samples
 double TStats::calcStDev(void)
 {
-    if (tnow <= 0.) { cerr<< "fatal error: TStats::calcStDev() => no samples!\n"; exit(1); }
+    if (tnow <= 0.)
+    {
+        if (!fatal) return NOT_A_NUMBER;
+        cerr<< "fatal error: TStats::calcStDev() => no samples!\n"; exit(1);
+    }
     double ave = (sum / tnow);
     double var = ((sumsq/tnow) - (ave * ave));
     return sqrt(var);
 }
 
 
+// get mean of samples; returns false if no time has elapsed
+bool TStats::calcMean(double& mean)
+{
+    if (tnow <= 0.) return false;
+    mean = sum/tnow;
+    return true;
+}
+
+
+// get standard deviation of samples; returns false if no time has elapsed
+bool TStats::calcStDev(double& stdev)
+{
+    if (tnow <= 0.) return false;
+    double ave = (sum / tnow);
+    double var = ((sumsq/tnow) - (ave * ave));
+    stdev = sqrt(var);
+    return true;
+}
+
+
+// get minimum of samples; returns false if no time has elapsed
+bool TStats::calcMin(double& m)
+{
+    if (tnow <= 0.) return false;
+    m = min;
+    return true;
+}
+
+
+// get maximum of samples; returns false if no time has elapsed
+bool TStats::calcMax(double& m)
+{
+    if (tnow <= 0.) return false;
+    m = max;
+    return true;
+}
+
+
 // print time statistics
 void TStats::printTStats(char* varname, int width, int precision, int verbose)
 {
-    if (tnow <= 0.) { cerr<< "fatal error: TStats::printStats() => no samples!\n"; exit(1); }
+    if (tnow <= 0.)
+    {
+        if (!fatal)
+        {
+            cerr << "warning: TStats::printTStats(): no samples, no statistics to print! ";
+            cerr << "(" << errors << " rejected samples)\n\n";
+            return;
+        }
+        cerr<< "fatal error: TStats::printStats() => no samples!\n"; exit(1);
+    }
 
     cout << setiosflags(ios::fixed|ios::showpoint);
     cout << setprecision(precision);
@@ -299,6 +434,7 @@ void TStats::printTStats(char* varname, int width, int precision, int verbose)
         cout << "Standard Dev   : " << setw(width) << calcStDev() << "\n";
         cout << "Min            : " << setw(width) << calcMin() << "\n";
         cout << "Max            : " << setw(width) << calcMax();
+        if (errors) cout << "\nRejected       : " << setw(width) << errors;
         cout << "\n----------------------------------------\n";
     }
     else
@@ -309,6 +445,7 @@ void TStats::printTStats(char* varname, int width, int precision, int verbose)
         cout << setw(width) << calcStDev() << " ";
         cout << setw(width) << calcMin() << " ";
         cout << setw(width) << calcMax() << " ";
+        if (errors) cout << setw(width) << errors << " rejected ";
     }
 }
 
@@ -316,7 +453,16 @@ void TStats::printTStats(char* varname, int width, int precision, int verbose)
 // print time histogram
 void TStats::printHistogram(char* varname, int width, int precision)
 {
-    if (tnow <= 0.) { cerr<< "fatal error: TStats::printHistogram() => no samples!\n"; exit(1); }
+    if (tnow <= 0.)
+    {
+        if (!fatal)
+        {
+            cerr << "warning: TStats::printHistogram(): no samples, no histogram to print! ";
+            cerr << "(" << errors << " rejected samples)\n\n";
+            return;
+        }
+        cerr<< "fatal error: TStats::printHistogram() => no samples!\n"; exit(1);
+    }
 
     if (!histo)
     {
@@ -345,6 +491,366 @@ void TStats::printHistogram(char* varname, int width, int precision)
 }
 
 
+/*---------------------------------------------------------------
+GroupedStats Functions
+---------------------------------------------------------------*/
+
+const unsigned GROUP_TABLE = 64;     // initial number of hash table slots (power of 2)
+const unsigned GROUP_PAGE  = 256;    // number of groups per page
+const size_t   NAME_PAGE   = 4096;   // bytes per page of string keys
+const size_t   GROUP_ALIGN = sizeof(double) > sizeof(void*) ? sizeof(double) : sizeof(void*);
+const size_t   PAGE_LINK   = GROUP_ALIGN; // bytes at start of a page holding link to previous page
+
+
+// round a size up to a multiple of GROUP_ALIGN
+static inline size_t alignSize(size_t n)
+{
+    return (n + GROUP_ALIGN - 1) / GROUP_ALIGN * GROUP_ALIGN;
+}
+
+
+// hash of a key (mixes all bits into the low bits, which select the slot)
+static inline unsigned long hashKey(unsigned long k)
+{
+    unsigned long h = k ^ ((k >> 16) >> 16); // folds high half of a 64-bit key (0 if 32-bit)
+    h &= 0xffffffffUL;
+    h ^= h >> 16;
+    h = (h * 0x85ebca6bUL) & 0xffffffffUL;
+    h ^= h >> 13;
+    h = (h * 0xc2b2ae35UL) & 0xffffffffUL;
+    h ^= h >> 16;
+    return h;
+}
+
+
+// key of a string (FNV-1a, 32 bits)
+static inline unsigned long hashName(const char* name)
+{
+    unsigned long h = 2166136261UL;
+    for (; *name; name++)
+    {
+        h ^= (unsigned char) *name;
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+    return h;
+}
+
+
+// free a list of pages
+static void freePages(char* page)
+{
+    while (page)
+    {
+        char* prev = *(char**) page;
+        delete [] page;
+        page = prev;
+    }
+}
+
+
+// class constructor (default, without histograms)
+GroupedStats::GroupedStats(void)
+{
+    histo = false;
+    lo = hi = 0.;
+    nbin = 0;
+    init();
+}
+
+
+// class constructor (with histograms)
+GroupedStats::GroupedStats(double low, double high, int bins)
+{
+    if (!((low<high) && (bins>0))) // input check
+    {
+        cerr<< "fatal error: GroupedStats::GroupedStats() => bad parameters to construct GroupedStats!\n";
+        exit(1);
+    }
+
+    histo = true;
+    lo = low;
+    hi = high;
+    nbin = bins;
+    init();
+}
+
+
+// common part of constructors
+void GroupedStats::init(void)
+{
+    // a group is a Stats object immediately followed by its histogram bins
+    fatal = true;
+    stride = alignSize(sizeof(Stats) + (histo ? (nbin+2)*sizeof(unsigned) : 0));
+
+    tablesize = GROUP_TABLE;
+    table = new Slot[tablesize];
+    memset(table, 0, tablesize*sizeof(Slot));
+
+    ngroups = 0;
+    maxgroups = GROUP_PAGE;
+    groups = new Stats*[maxgroups];
+    keys = new unsigned long[maxgroups];
+    names = new const char*[maxgroups];
+
+    pages = NULL;
+    namepages = NULL;
+    namefree = NULL;
+    nameleft = 0;
+}
+
+
+// class destructor
+GroupedStats::~GroupedStats(void)
+{
+    clearGroups();
+    delete [] table;
+    delete [] groups;
+    delete [] keys;
+    delete [] names;
+}
+
+
+// return Stats of group with integer key k, creating the group if needed
+Stats* GroupedStats::getStats(unsigned long k)
+{
+    unsigned mask = tablesize - 1;
+    unsigned i = hashKey(k) & mask;
+    for (;; i = (i+1) & mask)
+    {
+        Slot& s = table[i];
+        if (s.stats == NULL) return addGroup(k, NULL, i);
+        if ((s.key == k) && (s.name == NULL)) return s.stats;
+    }
+}
+
+
+// return Stats of group with string key name, creating the group if needed
+Stats* GroupedStats::getStatsByName(const char* name)
+{
+    unsigned long h = hashName(name);
+    unsigned mask = tablesize - 1;
+    unsigned i = hashKey(h) & mask;
+    for (;; i = (i+1) & mask)
+    {
+        Slot& s = table[i];
+        if (s.stats == NULL) return addGroup(h, allocName(name), i);
+        if ((s.key == h) && s.name && (strcmp(s.name, name) == 0)) return s.stats;
+    }
+}
+
+
+// return Stats of group with integer key k, or NULL if there is no such group
+Stats* GroupedStats::findStats(unsigned long k)
+{
+    unsigned mask = tablesize - 1;
+    unsigned i = hashKey(k) & mask;
+    for (;; i = (i+1) & mask)
+    {
+        Slot& s = table[i];
+        if (s.stats == NULL) return NULL;
+        if ((s.key == k) && (s.name == NULL)) return s.stats;
+    }
+}
+
+
+// return Stats of group with string key name, or NULL if there is no such group
+Stats* GroupedStats::findStatsByName(const char* name)
+{
+    unsigned long h = hashName(name);
+    unsigned mask = tablesize - 1;
+    unsigned i = hashKey(h) & mask;
+    for (;; i = (i+1) & mask)
+    {
+        Slot& s = table[i];
+        if (s.stats == NULL) return NULL;
+        if ((s.key == h) && s.name && (strcmp(s.name, name) == 0)) return s.stats;
+    }
+}
+
+
+// create a new group in empty slot i of the hash table
+Stats* GroupedStats::addGroup(unsigned long k, const char* name, unsigned i)
+{
+    if (ngroups == maxgroups) // grow group arrays
+    {
+        unsigned n = 2 * maxgroups;
+        Stats** g = new Stats*[n];
+        unsigned long* kk = new unsigned long[n];
+        const char** nn = new const char*[n];
+        memcpy(g, groups, ngroups*sizeof(Stats*));
+        memcpy(kk, keys, ngroups*sizeof(unsigned long));
+        memcpy(nn, names, ngroups*sizeof(const char*));
+        delete [] groups;
+        delete [] keys;
+        delete [] names;
+        groups = g;
+        keys = kk;
+        names = nn;
+        maxgroups = n;
+    }
+
+    unsigned j = ngroups % GROUP_PAGE;
+    if (j == 0) // current page is full, start a new one
+    {
+        char* page = new char[PAGE_LINK + GROUP_PAGE*stride];
+        *(char**) page = pages;
+        pages = page;
+    }
+
+    char* place = pages + PAGE_LINK + j*stride;
+    Stats* st = histo ? new (place) Stats(lo, hi, nbin, (unsigned*) (place + sizeof(Stats)))
+                      : new (place) Stats;
+    st->setFatal(fatal);
+
+    table[i].key = k;
+    table[i].name = name;
+    table[i].stats = st;
+    groups[ngroups] = st;
+    keys[ngroups] = k;
+    names[ngroups] = name;
+    ngroups++;
+
+    if (2*ngroups > tablesize) growTable(); // keep load factor at most 1/2
+    return st;
+}
+
+
+// double the size of the hash table
+void GroupedStats::growTable(void)
+{
+    unsigned n = 2 * tablesize;
+    unsigned mask = n - 1;
+    Slot* t = new Slot[n];
+    memset(t, 0, n*sizeof(Slot));
+
+    for (unsigned g=0; g < ngroups; g++)
+    {
+        unsigned long k = keys[g];
+        unsigned i = hashKey(k) & mask;
+        while (t[i].stats) i = (i+1) & mask;
+        t[i].key = k;
+        t[i].name = names[g];
+        t[i].stats = groups[g];
+    }
+
+    delete [] table;
+    table = t;
+    tablesize = n;
+}
+
+
+// copy a string key into the name pages
+char* GroupedStats::allocName(const char* name)
+{
+    size_t len = strlen(name) + 1;
+    if (len > nameleft) // current page is full, start a new one
+    {
+        size_t size = (len > NAME_PAGE) ? len : NAME_PAGE;
+        char* page = new char[PAGE_LINK + size];
+        *(char**) page = namepages;
+        namepages = page;
+        namefree = page + PAGE_LINK;
+        nameleft = size;
+    }
+
+    char* s = namefree;
+    memcpy(s, name, len);
+    namefree += len;
+    nameleft -= len;
+    return s;
+}
+
+
+// take n samples: values[i] for group keys[i]
+void GroupedStats::takeSamples(const int* k, const double* values, int n)
+{
+    for (int i=0; i < n; i++)
+        getStats(k[i])->takeSample(values[i]);
+}
+
+
+// take n samples: values[i] for group keys[i]
+void GroupedStats::takeSamples(const unsigned* k, const double* values, int n)
+{
+    for (int i=0; i < n; i++)
+        getStats(k[i])->takeSample(values[i]);
+}
+
+
+// take n samples: values[i] for group keys[i]
+void GroupedStats::takeSamples(const unsigned long* k, const double* values, int n)
+{
+    for (int i=0; i < n; i++)
+        getStats(k[i])->takeSample(values[i]);
+}
+
+
+// take n samples: values[i] for group names[i]
+void GroupedStats::takeSamplesByName(const char* const* k, const double* values, int n)
+{
+    for (int i=0; i < n; i++)
+        getStatsByName(k[i])->takeSample(values[i]);
+}
+
+
+// reset statistics of all groups, keeping the groups
+void GroupedStats::resetStats(void)
+{
+    for (unsigned g=0; g < ngroups; g++)
+        groups[g]->resetStats();
+}
+
+
+// set whether errors of all groups, present and future, are fatal
+void GroupedStats::setFatal(bool f)
+{
+    fatal = f;
+    for (unsigned g=0; g < ngroups; g++)
+        groups[g]->setFatal(f);
+}
+
+
+// remove all groups
+void GroupedStats::clearGroups(void)
+{
+    for (unsigned g=0; g < ngroups; g++)
+        groups[g]->~Stats();
+
+    freePages(pages);
+    freePages(namepages);
+    pages = NULL;
+    namepages = NULL;
+    namefree = NULL;
+    nameleft = 0;
+    ngroups = 0;
+    memset(table, 0, tablesize*sizeof(Slot));
+}
+
+
+// add samples of all groups of another GroupedStats into groups with the same keys
+void GroupedStats::mergeStats(GroupedStats& other)
+{
+    if ((histo != other.histo) ||
+        (histo && !((lo == other.lo) && (hi == other.hi) && (nbin == other.nbin))))
+    {
+        if (!fatal)
+        {
+            cerr << "warning: GroupedStats::mergeStats(): histograms do not match, nothing merged!\n\n";
+            return;
+        }
+        cerr<< "fatal error: GroupedStats::mergeStats() => histograms do not match!\n";
+        exit(1);
+    }
+
+    unsigned n = other.ngroups; // other may be this object
+    for (unsigned g=0; g < n; g++)
+    {
+        Stats* st = other.names[g] ? getStatsByName(other.names[g]) : getStats(other.keys[g]);
+        st->mergeStats(*other.groups[g]);
+    }
+}
+
+
 /*---------------------------------------------------------------
 Useful Non-class Functions
 ---------------------------------------------------------------*/
@@ -14,6 +14,7 @@
 
 #ifndef SHK_STATS_H
 #define SHK_STATS_H
+#include <stddef.h>
 namespace shk 
 {
 
@@ -42,6 +43,17 @@ This is how you use the class Stats in your C++ program:
        have declared Stats X.
     6. If you don't need a histogram to be calculated, you can create your Stats
        object without an argument, like: Stats X;
+    7. You can call X.mergeStats(Y) to add the samples collected by Stats Y into X,
+       as if they had been taken by X. Both must have the same histogram layout.
+    8. Samples that are NaN or infinite are rejected and counted; X.getErrorCount()
+       returns the number of rejected samples.
+    9. By default, asking for statistics of too few samples, or merging Stats with
+       different histograms, is a fatal error. After X.setFatal(false), calcMean() etc.
+       return NaN instead, printStats(), printHistogram() and mergeStats() print a
+       warning, and calcMean(m), calcVariance(m), calcStDev(m), calcMin(m) and
+       calcMax(m) return false without changing m (they return true and the
+       statistic in m when it exists). calcMin() and calcMax() of no samples return
+       DBL_MAX and -DBL_MAX.
 ---------------------------------------------------------------------------------------*/
 
 class Stats
@@ -51,6 +63,8 @@ class Stats
         Stats(double,double,int);                 // constructor (creates histogram)
         ~Stats(void);                             // destructor
         unsigned  getCount(void);                 // returns sample count
+        unsigned  getErrorCount(void);            // returns rejected sample count
+        void      setFatal(bool);                 // sets whether errors are fatal
         void      resetStats(void);               // resets statistics
         void      takeSample(double);             // inputs one sample value
         void      printStats(char*,int,int,int);  // prints statistics
@@ -58,10 +72,19 @@ class Stats
         double    calcMean(void);                 // returns sample mean
         double    calcVariance(void);             // returns sample variance
         double    calcStDev(void);                // returns sample standard deviation
+        bool      calcMean(double&);              // gets sample mean, if it exists
+        bool      calcVariance(double&);          // gets sample variance, if it exists
+        bool      calcStDev(double&);             // gets sample standard deviation, if it exists
+        bool      calcMin(double&);               // gets minimum of samples, if it exists
+        bool      calcMax(double&);               // gets maximum of samples, if it exists
         double    calcMin(void);                  // returns minimum of samples
         double    calcMax(void);                  // returns maximum of samples
         double    calcErrorMargin(double);        // returns margin of errors
+        void      mergeStats(Stats&);             // adds samples of another Stats into this one
     private:
+        friend class GroupedStats;                // constructs Stats with histograms in its arena
+        Stats(double,double,int,unsigned*);       // constructor (histogram storage owned by caller)
+        void      initHistogram(double,double,int,unsigned*); // common part of histogram constructors
         unsigned  count;                          // sample count
         double    sum;                            // sample sum
         double    sumsq;                          // sum of square of samples
@@ -73,11 +96,37 @@ class Stats
         double    lo;                             // lower bound of histogram
         double    hi;                             // higher bound of histogram
         unsigned* histogram;                      // array of histogram bins
+        bool      ownhisto;                       // histogram is deleted by destructor if ownhisto=true
+        unsigned  errors;                         // rejected sample count
+        bool      fatal;                          // errors are fatal if fatal=true
 };
 
-inline unsigned Stats::getCount() { return count; }
-inline double   Stats::calcMin () { return min;   }
-inline double   Stats::calcMax () { return max;   }
+inline unsigned Stats::getCount     () { return count;  }
+inline unsigned Stats::getErrorCount() { return errors; }
+inline void     Stats::setFatal (bool f) { fatal = f;   }
+inline double   Stats::calcMin      () { return min;    }
+inline double   Stats::calcMax      () { return max;    }
+
+// take one data sample (inline, as it is called for every sample)
+inline void Stats::takeSample(double x)
+{
+    if (!(x - x == 0.)) { errors++; return; } // reject NaN and infinite samples
+
+    count++ ;
+    sum += x;
+    sumsq += (x * x);
+    if (x < min) min = x;
+    if (x > max) max = x;
+
+    if (histo)
+    {
+        if ( x < lo ) { histogram[0]++; return; }
+        if ( x > hi ) { histogram[nbin+1]++; return; }
+
+        int i = ( (int) ((x - lo) / bin )) + 1;
+        histogram[i]++;
+    }
+}
 
 double calcErrorMargin(double,int,float);
 
@@ -108,6 +157,14 @@ This is how you use the class TStats in your C++ program:
        have declared TStats X.
     6. If you don't need a histogram to be calculated, you can create your TStats
        object without an argument, like:  TStats X;
+    7. Samples whose value or time is NaN or infinite, or whose time does not advance
+       past the previous sample, are rejected and counted; X.getErrorCount() returns
+       the number of rejected samples.
+    8. By default, a sample whose time does not advance, or asking for statistics
+       before any time has elapsed, is a fatal error. After X.setFatal(false), such
+       samples are only rejected and counted, calcMean() and calcStDev() return NaN,
+       printTStats() and printHistogram() print a warning, and calcMean(m),
+       calcStDev(m), calcMin(m) and calcMax(m) return false without changing m.
 ---------------------------------------------------------------------------------------*/
 
 class TStats
@@ -117,6 +174,8 @@ class TStats
         TStats(double,double,int);              // constructor (creates histogram)
         ~TStats(void);                          // destructor
         double  getTime(void);                  // returns time of most recent sample
+        unsigned getErrorCount(void);           // returns rejected sample count
+        void    setFatal(bool);                 // sets whether errors are fatal
         void    resetTStats(void);              // resets statistics
         void    takeSample(double,double);      // inputs one sample value
         void    printTStats(char*,int,int,int); // prints statistics
@@ -124,9 +183,14 @@ class TStats
         double  calcMean(void);                 // returns sample mean
         double  calcVariance(void);             // returns sample variance
         double  calcStDev(void);                // returns sample standard deviation
+        bool    calcMean(double&);              // gets sample mean, if it exists
+        bool    calcStDev(double&);             // gets sample standard deviation, if it exists
+        bool    calcMin(double&);               // gets minimum of samples, if it exists
+        bool    calcMax(double&);               // gets maximum of samples, if it exists
         double  calcMin(void);                  // returns minimum of samples
         double  calcMax(void);                  // returns maximum of samples
     private:
+        void    rejectSample(double);           // counts a rejected sample (out of line)
         double  tnow;                           // sampling time of most recent sample
         double  sum;                            // time integral of stochastic process
         double  sumsq;                          // time integral of square of stochastic process
@@ -138,11 +202,139 @@ class TStats
         double  lo;                             // lower bound of histogram
         double  hi;                             // higher bound of histogram
         double* histogram;                      // array of histogram bins
+        unsigned errors;                        // rejected sample count
+        bool    fatal;                          // errors are fatal if fatal=true
+};
+
+inline double   TStats::getTime      () { return tnow;   }
+inline unsigned TStats::getErrorCount() { return errors; }
+inline void     TStats::setFatal (bool f) { fatal = f;   }
+inline double   TStats::calcMin      () { return min;    }
+inline double   TStats::calcMax      () { return max;    }
+
+// take one data sample x, along with the time of sample tx
+// (inline, as it is called for every sample; errors are handled out of line)
+inline void TStats::takeSample(double x, double tx)
+{
+    double tdiff = tx - tnow;
+    if (!((tdiff > 0.) & (tdiff - tdiff == 0.) & (x - x == 0.))) { rejectSample(tdiff); return; }
+
+    tnow = tx;
+    sum += (x * tdiff);
+    sumsq += ( x * x * tdiff);
+
+    if (x < min) min = x;
+    if (x > max) max = x;
+
+    if (histo)
+    {
+        if ( x < lo ) { histogram[0] += tdiff; return; }
+        if ( x > hi ) { histogram[nbin+1] += tdiff; return; }
+
+        int i = ( (int) ((x - lo) / bin )) + 1;
+        histogram[i] += tdiff;
+    }
+}
+
+
+/*---------------------------------------------------------------------------------------
+Usage Guide for GroupedStats Class
+
+GroupedStats is a C++ class for collecting statistics on a random variable separately
+for many groups (categories), e.g. latency per customer class or per network node.
+Each group is identified by a key, which is either an integer or a string, and has
+its own Stats object. Functions taking string keys have names ending in ByName. Groups are created on demand the first time a key is seen.
+
+Groups live in a flat open-addressing hash table, and their Stats objects (together
+with their histogram bins) are carved out of large memory pages, so creating a group
+does not allocate memory per key, and taking a sample costs one hash table probe plus
+one update of the group's Stats.
+
+This is how you use the class GroupedStats in your C++ program:
+    1. Declare:  GroupedStats G(a,b,n); where a, b and n define the histogram of every
+       group as in Stats X(a,b,n). Declare GroupedStats G; if you need no histograms.
+    2. Every time your simulation generates a sample x for group k, call the function:
+       G.takeSample(k,x); where k is an integer, or G.takeSampleByName(s,x); where s
+       is a C string. Or call G.takeSamples(keys,values,m); where keys is an array of
+       int, unsigned or unsigned long, or G.takeSamplesByName(names,values,m); to take
+       m samples at once.
+    3. G.getStats(k) returns the Stats object of group k (creating it if needed),
+       and G.findStats(k) returns it only if group k exists, otherwise NULL.
+       Likewise G.getStatsByName(s) and G.findStatsByName(s) for string keys.
+    4. To visit all groups, loop for i = 0 to G.getGroupCount()-1 and call
+       G.getGroup(i) for the Stats object of the i-th group, and G.getKey(i) or
+       G.getName(i) for its key. getName(i) is NULL for groups with integer keys.
+    5. You can call G.resetStats() to reset the statistics of all groups (the groups
+       are kept), or G.clearGroups() to remove all groups.
+    6. You can call G.mergeStats(H) to add the samples of all groups of GroupedStats H
+       into the groups of G with the same keys. Both must have the same histogram layout.
+    7. G.setFatal(false) calls setFatal(false) on the Stats of every group, present
+       and future (see Stats above), and makes G.mergeStats(H) print a warning
+       instead of failing when the histograms do not match.
+---------------------------------------------------------------------------------------*/
+
+class GroupedStats
+{
+    public:
+        GroupedStats(void);                                  // default constructor (no histograms)
+        GroupedStats(double,double,int);                     // constructor (groups have histograms)
+        ~GroupedStats(void);                                 // destructor
+        unsigned      getGroupCount(void);                   // returns number of groups
+        Stats*        getGroup(unsigned);                    // returns Stats of i-th group
+        unsigned long getKey(unsigned);                      // returns integer key of i-th group
+        const char*   getName(unsigned);                     // returns string key of i-th group
+        Stats*        getStats(unsigned long);               // returns Stats of a group (creates it)
+        Stats*        getStatsByName(const char*);           // returns Stats of a group (creates it)
+        Stats*        findStats(unsigned long);              // returns Stats of a group, or NULL
+        Stats*        findStatsByName(const char*);          // returns Stats of a group, or NULL
+        void          takeSample(unsigned long,double);      // inputs one sample value of a group
+        void          takeSampleByName(const char*,double);  // inputs one sample value of a group
+        void          takeSamples(const int*,const double*,int);           // inputs many samples
+        void          takeSamples(const unsigned*,const double*,int);      // inputs many samples
+        void          takeSamples(const unsigned long*,const double*,int); // inputs many samples
+        void          takeSamplesByName(const char* const*,const double*,int); // inputs many samples
+        void          resetStats(void);                      // resets statistics of all groups
+        void          clearGroups(void);                     // removes all groups
+        void          setFatal(bool);                        // sets whether errors of groups are fatal
+        void          mergeStats(GroupedStats&);             // adds groups of another GroupedStats
+    private:
+        struct Slot                                          // hash table slot
+        {
+            unsigned long key;                               // integer key, or hash of string key
+            const char*   name;                              // string key (NULL for integer keys)
+            Stats*        stats;                             // Stats of group (NULL if slot is empty)
+        };
+        GroupedStats(const GroupedStats&);                   // not copyable
+        GroupedStats& operator=(const GroupedStats&);        // not copyable
+        void          init(void);                            // common part of constructors
+        Stats*        addGroup(unsigned long,const char*,unsigned); // creates a new group
+        void          growTable(void);                       // doubles hash table size
+        char*         allocName(const char*);                // copies a string key into arena
+        bool          histo;                                 // groups have histograms if histo=true
+        bool          fatal;                                 // errors of groups are fatal if fatal=true
+        double        lo;                                    // lower bound of histograms
+        double        hi;                                    // higher bound of histograms
+        int           nbin;                                  // number of bins in histograms
+        Slot*         table;                                 // hash table of groups
+        unsigned      tablesize;                             // number of slots (power of 2)
+        unsigned      ngroups;                               // number of groups
+        unsigned      maxgroups;                             // capacity of group arrays below
+        Stats**       groups;                                // Stats of groups, in creation order
+        unsigned long* keys;                                 // keys of groups, in creation order
+        const char**  names;                                 // string keys of groups, in creation order
+        size_t        stride;                                // bytes per group in a page
+        char*         pages;                                 // list of pages holding Stats and bins
+        char*         namepages;                             // list of pages holding string keys
+        char*         namefree;                              // next free byte in current name page
+        size_t        nameleft;                              // bytes left in current name page
 };
 
-inline double TStats::getTime() { return tnow; }
-inline double TStats::calcMin() { return min;  }
-inline double TStats::calcMax() { return max;  }
+inline unsigned      GroupedStats::getGroupCount()     { return ngroups;      }
+inline Stats*        GroupedStats::getGroup(unsigned i) { return groups[i];    }
+inline unsigned long GroupedStats::getKey  (unsigned i) { return keys[i];      }
+inline const char*   GroupedStats::getName (unsigned i) { return names[i];     }
+inline void GroupedStats::takeSample(unsigned long k, double x)     { getStats(k)->takeSample(x);       }
+inline void GroupedStats::takeSampleByName(const char* k, double x) { getStatsByName(k)->takeSample(x); }
 
 
 //-----------------------------------------------------------------------------------------
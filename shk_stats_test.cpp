@@ -14,6 +14,20 @@ double B[] = { 11., 52., 30., 61., 17., 5., 62., 12.,
                25., 16., 81., 29., 56., 46., 42., 92. };
 
 Stats X(0.,100.,10);
+Stats Y(0.,100.,10);
+
+
+// print what the status forms of the Stats Y queries return
+void printStatus()
+{
+    double m = 0., v = 0., s = 0., lo = 0., hi = 0.;
+    bool okm = Y.calcMean(m), okv = Y.calcVariance(v), oks = Y.calcStDev(s);
+    bool oklo = Y.calcMin(lo), okhi = Y.calcMax(hi);
+    cout << "samples " << Y.getCount() << ", rejected " << Y.getErrorCount() << ": ";
+    cout << "mean " << okm << " " << m << ", variance " << okv << " " << v;
+    cout << ", stdev " << oks << " " << s << ", min " << oklo << " " << lo;
+    cout << ", max " << okhi << " " << hi << "\n";
+}
 
 
 int main()
@@ -32,6 +46,24 @@ int main()
     X.printStats("B", 10, 4, 1);
     X.printHistogram("B", 8, 4);
 
+    // with errors not fatal, bad samples are rejected and counted,
+    // and statistics of too few samples are reported, not fatal
+    Y.setFatal(false);
+    Y.takeSample(0./0.);   // NaN sample
+    Y.takeSample(1./0.);   // infinite sample
+    cout << "\n";
+    printStatus();
+    Y.printStats("Y", 10, 4, 1);
+    Y.printHistogram("Y", 8, 4);
+
+    Y.takeSample(A[0]);
+    printStatus();
+    Y.printStats("Y", 10, 4, 1);
+
+    Y.takeSample(A[1]);
+    printStatus();
+    Y.printStats("Y", 10, 4, 1);
+
     return 0;
 }
 
@@ -14,6 +14,7 @@ double T[] = { 1., 1.5, 3.3, 6., 7.2, 8.5, 9., 11.6,
                13.25, 16.1, 41., 59., 66.6, 78., 147., 192.5 };
 
 TStats X(0.,100.,10);
+TStats Y(0.,100.,10);
 
 
 int main()
@@ -32,6 +33,21 @@ int main()
     X.printTStats("A", 10, 4, 1);
     X.printHistogram("A", 8, 4);
 
+    // with errors not fatal, bad samples are rejected and counted
+    Y.setFatal(false);
+    double mean;
+    if (!Y.calcMean(mean))
+        cout << "\nY has no samples yet\n";
+
+    for (int i = 0; i<N; i++)
+    {
+        Y.takeSample(A[i],T[i]);
+        Y.takeSample(A[i],T[i]/2.);  // time goes backwards
+    }
+    Y.takeSample(0./0.,200.);        // NaN sample
+
+    Y.printTStats("A", 10, 4, 1);
+
     return 0;
 }
 